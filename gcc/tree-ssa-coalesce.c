@@ -59,6 +59,7 @@ along with GCC; see the file COPYING3.  If not see
 #include "tree-ssa-live.h"
 #include "tree-ssa-coalesce.h"
 #include "diagnostic-core.h"
+#include "alloc-pool.h"
 
 
 /* This set of routines implements a coalesce_list.  This is an object which
@@ -75,7 +76,6 @@ typedef struct coalesce_pair
   int second_element;
   int cost;
 } * coalesce_pair_p;
-typedef const struct coalesce_pair *const_coalesce_pair_p;
 
 /* Coalesce pair hashtable helpers.  */
 
@@ -124,9 +124,11 @@ typedef struct cost_one_pair_d
 typedef struct coalesce_list_d
 {
   coalesce_table_type *list;	/* Hash table.  */
-  coalesce_pair_p *sorted;	/* List when sorted.  */
+  coalesce_pair *sorted;	/* Flat copy of the pairs when sorted.  */
   int num_sorted;		/* Number in the sorted list.  */
   cost_one_pair_p cost_one_list;/* Single use coalesces with cost 1.  */
+  alloc_pool pair_pool;		/* Allocator for the pair nodes.  */
+  alloc_pool cost_one_pool;	/* Allocator for the cost-one nodes.  */
 } *coalesce_list_p;
 
 #define NO_BEST_COALESCE	-1
@@ -217,8 +219,6 @@ pop_cost_one_pair (coalesce_list_p cl, int *p1, int *p2)
   *p2 = ptr->second_element;
   cl->cost_one_list = ptr->next;
 
-  free (ptr);
-
   return 1;
 }
 
@@ -238,11 +238,10 @@ pop_best_coalesce (coalesce_list_p cl, int *p1, int *p2)
   if (cl->num_sorted == 0)
     return pop_cost_one_pair (cl, p1, p2);
 
-  node = cl->sorted[--(cl->num_sorted)];
+  node = &cl->sorted[--(cl->num_sorted)];
   *p1 = node->first_element;
   *p2 = node->second_element;
   ret = node->cost;
-  free (node);
 
   return ret;
 }
@@ -264,6 +263,11 @@ create_coalesce_list (void)
   list->sorted = NULL;
   list->num_sorted = 0;
   list->cost_one_list = NULL;
+  list->pair_pool = create_alloc_pool ("coalesce pair pool",
+				       sizeof (struct coalesce_pair), 64);
+  list->cost_one_pool = create_alloc_pool ("cost one pair pool",
+					   sizeof (struct cost_one_pair_d),
+					   64);
   return list;
 }
 
@@ -276,7 +280,9 @@ delete_coalesce_list (coalesce_list_p cl)
   gcc_assert (cl->cost_one_list == NULL);
   delete cl->list;
   cl->list = NULL;
-  free (cl->sorted);
+  free_alloc_pool (cl->pair_pool);
+  free_alloc_pool (cl->cost_one_pool);
+  /* cl->sorted points into the static scratch vector.  */
   gcc_assert (cl->num_sorted == 0);
   free (cl);
 }
@@ -294,16 +300,8 @@ find_coalesce_pair (coalesce_list_p cl, int p1, int p2, bool create)
   unsigned int hash;
 
   /* Normalize so that p1 is the smaller value.  */
-  if (p2 < p1)
-    {
-      p.first_element = p2;
-      p.second_element = p1;
-    }
-  else
-    {
-      p.first_element = p1;
-      p.second_element = p2;
-    }
+  p.first_element = MIN (p1, p2);
+  p.second_element = MAX (p1, p2);
 
   hash = coalesce_pair_hasher::hash (&p);
   slot = cl->list->find_slot_with_hash (&p, hash, create ? INSERT : NO_INSERT);
@@ -312,7 +310,8 @@ find_coalesce_pair (coalesce_list_p cl, int p1, int p2, bool create)
 
   if (!*slot)
     {
-      struct coalesce_pair * pair = XNEW (struct coalesce_pair);
+      struct coalesce_pair *pair
+	= (struct coalesce_pair *) pool_alloc (cl->pair_pool);
       gcc_assert (cl->sorted == NULL);
       pair->first_element = p.first_element;
       pair->second_element = p.second_element;
@@ -328,7 +327,7 @@ add_cost_one_coalesce (coalesce_list_p cl, int p1, int p2)
 {
   cost_one_pair_p pair;
 
-  pair = XNEW (struct cost_one_pair_d);
+  pair = (cost_one_pair_p) pool_alloc (cl->cost_one_pool);
   pair->first_element = p1;
   pair->second_element = p2;
   pair->next = cl->cost_one_list;
@@ -360,27 +359,116 @@ add_coalesce (coalesce_list_p cl, int p1, int p2, int value)
 }
 
 
-/* Comparison function to allow qsort to sort P1 and P2 in Ascending order.  */
+/* Return true if pair A must be placed after pair B in the sorted list:
+   ascending cost, with ties broken by descending first and then second
+   element.  The full ordering on the elements provides independence
+   from the order the pairs are presented in.  */
 
-static int
-compare_pairs (const void *p1, const void *p2)
+static inline bool
+coalesce_pair_follows_p (const coalesce_pair *a, const coalesce_pair *b)
 {
-  const_coalesce_pair_p const *const pp1 = (const_coalesce_pair_p const *) p1;
-  const_coalesce_pair_p const *const pp2 = (const_coalesce_pair_p const *) p2;
-  int result;
-
-  result = (* pp1)->cost - (* pp2)->cost;
-  /* Since qsort does not guarantee stability we use the elements
-     as a secondary key.  This provides us with independence from
-     the host's implementation of the sorting algorithm.  */
-  if (result == 0)
+  if (a->cost != b->cost)
+    return a->cost > b->cost;
+  if (a->first_element != b->first_element)
+    return a->first_element < b->first_element;
+  return a->second_element < b->second_element;
+}
+
+
+/* Sort the NUM pairs in LIST with an insertion sort.  This is only used
+   below the radix sort cutoff, where the inlined comparison beats
+   calling qsort with a comparator through a function pointer.  */
+
+static void
+insertion_sort_coalesce_pairs (coalesce_pair *list, unsigned num)
+{
+  unsigned i, j;
+
+  for (i = 1; i < num; i++)
     {
-      result = (* pp2)->first_element - (* pp1)->first_element;
-      if (result == 0)
-	result = (* pp2)->second_element - (* pp1)->second_element;
+      coalesce_pair tem = list[i];
+      for (j = i; j > 0 && coalesce_pair_follows_p (&list[j - 1], &tem); j--)
+	list[j] = list[j - 1];
+      list[j] = tem;
     }
+}
+
+
+/* Lists with at least this many pairs are sorted with the radix sort;
+   shorter ones fall back to the insertion sort.  */
+#define COALESCE_RADIX_SORT_MIN	64
 
-  return result;
+/* Return the sort key of PAIR for significance level KEY, 0 being the
+   least significant.  The keys are biased so that sorting each of them
+   in ascending unsigned order, least significant key first with a
+   stable sort, reproduces the ordering of coalesce_pair_follows_p:
+   ascending cost, with ties broken by descending first and second
+   elements.  */
+
+static inline uint32_t
+coalesce_pair_sort_key (const coalesce_pair *pair, int key)
+{
+  switch (key)
+    {
+    case 0:
+      return ~((uint32_t) pair->second_element ^ 0x80000000);
+    case 1:
+      return ~((uint32_t) pair->first_element ^ 0x80000000);
+    default:
+      return (uint32_t) pair->cost ^ 0x80000000;
+    }
+}
+
+
+/* Sort the NUM pairs in LIST into the order coalesce_pair_follows_p
+   defines using a byte-wise LSD radix sort.  Counting passes are
+   stable, so running them over the three keys from least to most
+   significant yields the multi-key order without any comparator calls.
+   Passes in which all pairs share the same key byte are skipped, which
+   is the common case for the high bytes of partition numbers and
+   costs.  */
+
+static void
+sort_coalesce_pairs (coalesce_pair *list, unsigned num)
+{
+  coalesce_pair *tmp = XNEWVEC (coalesce_pair, num);
+  coalesce_pair *src = list;
+  coalesce_pair *dst = tmp;
+  int key, shift;
+  unsigned x;
+
+  for (key = 0; key < 3; key++)
+    for (shift = 0; shift < 32; shift += 8)
+      {
+	unsigned count[256];
+	unsigned accum;
+
+	memset (count, 0, sizeof (count));
+	for (x = 0; x < num; x++)
+	  count[(coalesce_pair_sort_key (&src[x], key) >> shift) & 0xff]++;
+
+	if (count[(coalesce_pair_sort_key (&src[0], key) >> shift) & 0xff]
+	    == num)
+	  continue;
+
+	accum = 0;
+	for (x = 0; x < 256; x++)
+	  {
+	    unsigned tem = count[x];
+	    count[x] = accum;
+	    accum += tem;
+	  }
+
+	for (x = 0; x < num; x++)
+	  dst[count[(coalesce_pair_sort_key (&src[x], key) >> shift)
+		    & 0xff]++] = src[x];
+
+	std::swap (src, dst);
+      }
+
+  if (src != list)
+    memcpy (list, src, num * sizeof (*list));
+  free (tmp);
 }
 
 
@@ -399,6 +487,14 @@ num_coalesce_pairs (coalesce_list_p cl)
   FOR_EACH_HASH_TABLE_ELEMENT (*(CL)->list, (PAIR), coalesce_pair_p, (ITER))
 
 
+/* Buffer reused for the sorted pair vector, grown as needed and kept
+   across functions.  Only one coalesce list exists at a time (the
+   coalescer runs once per function going out of SSA), so reusing a
+   static buffer saves a malloc/free pair per function compiled.  It is
+   never freed.  */
+static coalesce_pair *sort_scratch;
+static unsigned sort_scratch_size;
+
 /* Prepare CL for removal of preferred pairs.  When finished they are sorted
    in order from most important coalesce to least important.  */
 
@@ -416,34 +512,46 @@ sort_coalesce_list (coalesce_list_p cl)
   if (num == 0)
     return;
 
-  /* Allocate a vector for the pair pointers.  */
-  cl->sorted = XNEWVEC (coalesce_pair_p, num);
+  /* Use the scratch vector for the pairs.  Copying them out of the hash
+     table nodes keeps the sort and the subsequent pops working on
+     contiguous memory instead of chasing a pointer per entry.  */
+  if (num > sort_scratch_size)
+    {
+      sort_scratch = XRESIZEVEC (coalesce_pair, sort_scratch, num);
+      sort_scratch_size = num;
+    }
+  cl->sorted = sort_scratch;
 
-  /* Populate the vector with pointers to the pairs.  */
+  /* Populate the vector with the pairs.  */
   x = 0;
   FOR_EACH_PARTITION_PAIR (p, ppi, cl)
-    cl->sorted[x++] = p;
+    cl->sorted[x++] = *p;
   gcc_assert (x == num);
 
   /* Already sorted.  */
   if (num == 1)
     return;
 
-  /* If there are only 2, just pick swap them if the order isn't correct.  */
+  /* If there are only 2, just swap them if the order isn't correct.
+     The costs compare either way about equally often, so select the
+     order with conditional moves rather than an unpredictable branch.  */
   if (num == 2)
     {
-      if (cl->sorted[0]->cost > cl->sorted[1]->cost)
-        {
-	  p = cl->sorted[0];
-	  cl->sorted[0] = cl->sorted[1];
-	  cl->sorted[1] = p;
-	}
+      coalesce_pair pair0 = cl->sorted[0];
+      coalesce_pair pair1 = cl->sorted[1];
+      bool swap = pair0.cost > pair1.cost;
+      cl->sorted[0] = swap ? pair1 : pair0;
+      cl->sorted[1] = swap ? pair0 : pair1;
       return;
     }
 
-  /* Only call qsort if there are more than 2 items.  */
-  if (num > 2)
-      qsort (cl->sorted, num, sizeof (coalesce_pair_p), compare_pairs);
+  /* Insertion sort the small lists; everything else goes through the
+     radix sort.  Neither path calls a comparator through a function
+     pointer.  */
+  if (num < COALESCE_RADIX_SORT_MIN)
+    insertion_sort_coalesce_pairs (cl->sorted, num);
+  else
+    sort_coalesce_pairs (cl->sorted, num);
 }
 
 
@@ -477,7 +585,7 @@ dump_coalesce_list (FILE *f, coalesce_list_p cl)
       fprintf (f, "Sorted Coalesce list:\n");
       for (x = cl->num_sorted - 1 ; x >=0; x--)
         {
-	  node = cl->sorted[x];
+	  node = &cl->sorted[x];
 	  fprintf (f, "(%d) ", node->cost);
 	  var = ssa_name (node->first_element);
 	  print_generic_expr (f, var, TDF_SLIM);
@@ -557,14 +665,23 @@ ssa_conflicts_add_one (ssa_conflicts_p ptr, unsigned x, unsigned y)
 }
 
 
-/* Add conflicts between X and Y in graph PTR.  */
+/* Add conflicts between X and every member of OTHERS in graph PTR.  X must
+   not be a member of OTHERS.  X's bitmap is looked up just once and OTHERS
+   is OR-ed into it wholesale rather than setting its bits one at a time.  */
 
 static inline void
-ssa_conflicts_add (ssa_conflicts_p ptr, unsigned x, unsigned y)
+ssa_conflicts_add_many (ssa_conflicts_p ptr, unsigned x, bitmap others)
 {
-  gcc_checking_assert (x != y);
-  ssa_conflicts_add_one (ptr, x, y);
-  ssa_conflicts_add_one (ptr, y, x);
+  unsigned y;
+  bitmap_iterator bi;
+  bitmap bx = ptr->conflicts[x];
+
+  gcc_checking_assert (!bitmap_bit_p (others, x));
+  if (! bx)
+    bx = ptr->conflicts[x] = BITMAP_ALLOC (&ptr->obstack);
+  bitmap_ior_into (bx, others);
+  EXECUTE_IF_SET_IN_BITMAP (others, 0, y, bi)
+    ssa_conflicts_add_one (ptr, y, x);
 }
 
 
@@ -728,24 +845,6 @@ live_track_clear_var (live_track_p ptr, tree var)
 }
 
 
-/* Return TRUE if VAR is live in PTR.  */
-
-static inline bool
-live_track_live_p (live_track_p ptr, tree var)
-{
-  int p, root;
-
-  p = var_to_partition (ptr->map, var);
-  if (p != NO_PARTITION)
-    {
-      root = basevar_index (ptr->map, p);
-      if (bitmap_bit_p (ptr->live_base_var, root))
-	return bitmap_bit_p (ptr->live_base_partitions[root], p);
-    }
-  return false;
-}
-
-
 /* This routine will add USE to PTR.  USE will be marked as live in both the
    ssa live map and the live bitmap for the root of USE.  */
 
@@ -772,24 +871,55 @@ live_track_process_def (live_track_p ptr, tree def, ssa_conflicts_p graph)
 {
   int p, root;
   bitmap b;
-  unsigned x;
-  bitmap_iterator bi;
 
   p = var_to_partition (ptr->map, def);
   if (p == NO_PARTITION)
     return;
 
-  /* Clear the liveness bit.  */
-  live_track_remove_partition (ptr, p);
+  /* Clear the liveness bit, and if other partitions with the same base
+     are still live, add the conflicts.  Doing both here lets the base
+     index and element bitmap be looked up only once.  */
+  root = basevar_index (ptr->map, p);
+  b = ptr->live_base_partitions[root];
+  bitmap_clear_bit (b, p);
+  if (bitmap_empty_p (b))
+    bitmap_clear_bit (ptr->live_base_var, root);
+  else if (bitmap_bit_p (ptr->live_base_var, root))
+    ssa_conflicts_add_many (graph, p, b);
+}
+
+
+/* Process the result of a PHI node as a def in PTR, but only if it is
+   currently live.  This is the fused form of a live_track_live_p test
+   followed by live_track_process_def; doing both here means the partition
+   number and base variable index are only looked up once.  */
+
+static inline void
+live_track_process_phi_def (live_track_p ptr, tree def, ssa_conflicts_p graph)
+{
+  int p, root;
+  bitmap b;
+
+  p = var_to_partition (ptr->map, def);
+  if (p == NO_PARTITION)
+    return;
 
-  /* If the bitmap isn't empty now, conflicts need to be added.  */
+  /* If the base variable isn't live, the element list is stale and DEF
+     is not live either.  */
   root = basevar_index (ptr->map, p);
-  if (bitmap_bit_p (ptr->live_base_var, root))
-    {
-      b = ptr->live_base_partitions[root];
-      EXECUTE_IF_SET_IN_BITMAP (b, 0, x, bi)
-        ssa_conflicts_add (graph, p, x);
-    }
+  if (!bitmap_bit_p (ptr->live_base_var, root))
+    return;
+
+  /* Clearing the liveness bit also performs the liveness test; if it was
+     not set, there is nothing to do.  */
+  b = ptr->live_base_partitions[root];
+  if (!bitmap_clear_bit (b, p))
+    return;
+
+  if (bitmap_empty_p (b))
+    bitmap_clear_bit (ptr->live_base_var, root);
+  else
+    ssa_conflicts_add_many (graph, p, b);
 }
 
 
@@ -886,8 +1016,7 @@ build_ssa_conflict_graph (tree_live_info_p liveinfo)
 	{
 	  gphi *phi = gsi.phi ();
 	  tree result = PHI_RESULT (phi);
-	  if (live_track_live_p (live, result))
-	    live_track_process_def (live, result, graph);
+	  live_track_process_phi_def (live, result, graph);
 	}
 
      live_track_clear_base_vars (live);
@@ -977,15 +1106,16 @@ create_outofssa_var_map (coalesce_list_p cl, bitmap used_in_copy)
 	      if (gimple_can_coalesce_p (arg, res)
 		  || (e->flags & EDGE_ABNORMAL))
 		{
+		  int arg_ver = SSA_NAME_VERSION (arg);
 		  saw_copy = true;
-		  bitmap_set_bit (used_in_copy, SSA_NAME_VERSION (arg));
+		  bitmap_set_bit (used_in_copy, arg_ver);
 		  if ((e->flags & EDGE_ABNORMAL) == 0)
 		    {
 		      int cost = coalesce_cost_edge (e);
 		      if (cost == 1 && has_single_use (arg))
-			add_cost_one_coalesce (cl, ver, SSA_NAME_VERSION (arg));
+			add_cost_one_coalesce (cl, ver, arg_ver);
 		      else
-			add_coalesce (cl, ver, SSA_NAME_VERSION (arg), cost);
+			add_coalesce (cl, ver, arg_ver, cost);
 		    }
 		}
 	    }
@@ -1085,7 +1215,8 @@ create_outofssa_var_map (coalesce_list_p cl, bitmap used_in_copy)
   /* Now process result decls and live on entry variables for entry into
      the coalesce list.  */
   first = NULL_TREE;
-  for (i = 1; i < num_ssa_names; i++)
+  unsigned num_names = num_ssa_names;
+  for (i = 1; i < num_names; i++)
     {
       var = ssa_name (i);
       if (var != NULL_TREE && !virtual_operand_p (var))
@@ -1294,7 +1425,8 @@ coalesce_ssa_name (void)
     {
       hash_table<ssa_name_var_hash> ssa_name_hash (10);
 
-      for (i = 1; i < num_ssa_names; i++)
+      unsigned num_names = num_ssa_names;
+      for (i = 1; i < num_names; i++)
 	{
 	  tree a = ssa_name (i);
 
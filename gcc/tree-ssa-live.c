@@ -237,25 +237,21 @@ delete_var_map (var_map map)
 int
 var_union (var_map map, tree var1, tree var2)
 {
-  int p1, p2, p3;
+  int p3;
 
   gcc_assert (TREE_CODE (var1) == SSA_NAME);
   gcc_assert (TREE_CODE (var2) == SSA_NAME);
 
   /* This is independent of partition_to_view. If partition_to_view is
      on, then whichever one of these partitions is absorbed will never have a
-     dereference into the partition_to_view array any more.  */
+     dereference into the partition_to_view array any more.
 
-  p1 = partition_find (map->var_partition, SSA_NAME_VERSION (var1));
-  p2 = partition_find (map->var_partition, SSA_NAME_VERSION (var2));
+     partition_union looks up the representative of each element itself and
+     is a no-op when both are already in the same class, so there is no need
+     for explicit partition_find calls here.  */
 
-  gcc_assert (p1 != NO_PARTITION);
-  gcc_assert (p2 != NO_PARTITION);
-
-  if (p1 == p2)
-    p3 = p1;
-  else
-    p3 = partition_union (map->var_partition, p1, p2);
+  p3 = partition_union (map->var_partition, SSA_NAME_VERSION (var1),
+			SSA_NAME_VERSION (var2));
 
   if (map->partition_to_view)
     p3 = map->partition_to_view[p3];
@@ -310,10 +306,11 @@ partition_view_init (var_map map)
   /* Find out which partitions are actually referenced.  */
   for (x = 0; x < map->partition_size; x++)
     {
+      tree name;
       tmp = partition_find (map->var_partition, x);
-      if (ssa_name (tmp) != NULL_TREE && !virtual_operand_p (ssa_name (tmp))
-	  && (!has_zero_uses (ssa_name (tmp))
-	      || !SSA_NAME_IS_DEFAULT_DEF (ssa_name (tmp))))
+      name = ssa_name (tmp);
+      if (name != NULL_TREE && !virtual_operand_p (name)
+	  && (!has_zero_uses (name) || !SSA_NAME_IS_DEFAULT_DEF (name)))
 	bitmap_set_bit (used, tmp);
     }
 
@@ -694,11 +691,43 @@ remove_unused_scope_block_p (tree scope, bool in_ctor_dtor_block)
 }
 
 /* Mark all VAR_DECLS under *EXPR_P as used, so that they won't be
-   eliminated during the tree->rtl conversion process.  */
+   eliminated during the tree->rtl conversion process.
+
+   Most operands are plain SSA_NAMEs or decls, for which walk_tree's
+   generic dispatch is pure overhead; handle those leaves inline and
+   only fall back to the full walk for real expressions.  This must
+   mirror what mark_all_vars_used_1 does for the same nodes.  */
 
 static inline void
 mark_all_vars_used (tree *expr_p)
 {
+  tree t = *expr_p;
+
+  if (t == NULL_TREE)
+    return;
+
+  if (TREE_CODE (t) == SSA_NAME)
+    {
+      t = SSA_NAME_VAR (t);
+      if (!t)
+	return;
+    }
+
+  if (IS_TYPE_OR_DECL_P (t))
+    {
+      if (TREE_CODE (t) == VAR_DECL)
+	{
+	  /* When a global var becomes used for the first time also walk its
+	     initializer (non global ones don't have any).  */
+	  if (set_is_used (t) && is_global_var (t)
+	      && DECL_CONTEXT (t) == current_function_decl)
+	    mark_all_vars_used (&DECL_INITIAL (t));
+	}
+      else if (TREE_CODE (t) == LABEL_DECL)
+	TREE_USED (t) = 1;
+      return;
+    }
+
   walk_tree (expr_p, mark_all_vars_used_1, NULL, NULL);
 }
 
@@ -1000,23 +1029,27 @@ static tree_live_info_p
 new_tree_live_info (var_map map)
 {
   tree_live_info_p live;
-  basic_block bb;
+  int num_blocks = last_basic_block_for_fn (cfun);
+  int i;
 
   live = XNEW (struct tree_live_info_d);
   live->map = map;
-  live->num_blocks = last_basic_block_for_fn (cfun);
+  live->num_blocks = num_blocks;
 
+  /* Initialize the bitmap heads in index order so the arrays are written
+     sequentially; the elements themselves are all allocated from the
+     obstacks below, keeping each set's storage contiguous.  */
   bitmap_obstack_initialize (&live->livein_obstack);
   bitmap_obstack_initialize (&live->liveout_obstack);
-  live->livein = XNEWVEC (bitmap_head, last_basic_block_for_fn (cfun));
-  FOR_EACH_BB_FN (bb, cfun)
-    bitmap_initialize (&live->livein[bb->index], &live->livein_obstack);
+  live->livein = XNEWVEC (bitmap_head, num_blocks);
+  for (i = 0; i < num_blocks; i++)
+    bitmap_initialize (&live->livein[i], &live->livein_obstack);
 
-  live->liveout = XNEWVEC (bitmap_head, last_basic_block_for_fn (cfun));
-  FOR_EACH_BB_FN (bb, cfun)
-    bitmap_initialize (&live->liveout[bb->index], &live->liveout_obstack);
+  live->liveout = XNEWVEC (bitmap_head, num_blocks);
+  for (i = 0; i < num_blocks; i++)
+    bitmap_initialize (&live->liveout[i], &live->liveout_obstack);
 
-  live->work_stack = XNEWVEC (int, last_basic_block_for_fn (cfun));
+  live->work_stack = XNEWVEC (int, num_blocks);
   live->stack_top = live->work_stack;
 
   live->global = BITMAP_ALLOC (NULL);
@@ -1096,7 +1129,7 @@ live_worklist (tree_live_info_p live)
 {
   unsigned b;
   basic_block bb;
-  sbitmap visited = sbitmap_alloc (last_basic_block_for_fn (cfun) + 1);
+  sbitmap visited = sbitmap_alloc (last_basic_block_for_fn (cfun));
 
   bitmap_clear (visited);
 
@@ -1116,23 +1149,24 @@ live_worklist (tree_live_info_p live)
 }
 
 
-/* Calculate the initial live on entry vector for SSA_NAME using immediate_use
-   links.  Set the live on entry fields in LIVE.  Def's are marked temporarily
-   in the liveout vector.  */
+/* Calculate the initial live on entry vector for SSA_NAME, the variable
+   representing partition P, using immediate_use links.  Set the live on
+   entry fields in LIVE.  Def's are marked temporarily in the liveout
+   vector.  */
 
 static void
-set_var_live_on_entry (tree ssa_name, tree_live_info_p live)
+set_var_live_on_entry (tree ssa_name, int p, tree_live_info_p live)
 {
-  int p;
   gimple stmt;
   use_operand_p use;
   basic_block def_bb = NULL;
+  basic_block prev_added = NULL;
   imm_use_iterator imm_iter;
   bool global = false;
 
-  p = var_to_partition (live->map, ssa_name);
-  if (p == NO_PARTITION)
-    return;
+  /* The caller obtained SSA_NAME from partition P of the view, so mapping
+     it back must yield the same partition.  */
+  gcc_checking_assert (p == var_to_partition (live->map, ssa_name));
 
   stmt = SSA_NAME_DEF_STMT (ssa_name);
   if (stmt)
@@ -1179,11 +1213,18 @@ set_var_live_on_entry (tree ssa_name, tree_live_info_p live)
 	    add_block = use_bb;
 	}
 
-      /* If there was a live on entry use, set the bit.  */
+      /* If there was a live on entry use, set the bit.  Runs of uses in
+	 the same block are common (several operands of one statement, or
+	 several statements in a row), so skip the bitmap update when the
+	 bit was just set for the previous use.  */
       if (add_block)
         {
 	  global = true;
-	  bitmap_set_bit (&live->livein[add_block->index], p);
+	  if (add_block != prev_added)
+	    {
+	      bitmap_set_bit (&live->livein[add_block->index], p);
+	      prev_added = add_block;
+	    }
 	}
     }
 
@@ -1251,14 +1292,15 @@ calculate_live_ranges (var_map map, bool want_livein)
 {
   tree var;
   unsigned i;
+  unsigned num = num_var_partitions (map);
   tree_live_info_p live;
 
   live = new_tree_live_info (map);
-  for (i = 0; i < num_var_partitions (map); i++)
+  for (i = 0; i < num; i++)
     {
       var = partition_to_var (map, i);
       if (var != NULL_TREE)
-	set_var_live_on_entry (var, live);
+	set_var_live_on_entry (var, i, live);
     }
 
   live_worklist (live);
@@ -1285,9 +1327,32 @@ calculate_live_ranges (var_map map, bool want_livein)
 void
 dump_var_map (FILE *f, var_map map)
 {
-  int t;
-  unsigned x, y;
+  int y;
+  unsigned x;
+  unsigned num_names = num_ssa_names;
   int p;
+  int *head;
+  int *next;
+
+  /* Bucket the ssa name versions by partition up front, so each version
+     is mapped to its partition just once instead of being rescanned for
+     every partition.  Inserting at the head in decreasing version order
+     leaves each member list sorted by increasing version.  */
+  head = XNEWVEC (int, map->num_partitions);
+  next = XNEWVEC (int, num_names);
+  for (x = 0; x < map->num_partitions; x++)
+    head[x] = -1;
+  for (y = (int) num_names - 1; y >= 1; y--)
+    {
+      p = partition_find (map->var_partition, y);
+      if (map->partition_to_view)
+	p = map->partition_to_view[p];
+      if (p != NO_PARTITION)
+	{
+	  next[y] = head[p];
+	  head[p] = y;
+	}
+    }
 
   fprintf (f, "\nPartition map \n\n");
 
@@ -1302,27 +1367,20 @@ dump_var_map (FILE *f, var_map map)
 	  || virtual_operand_p (ssa_name (p)))
         continue;
 
-      t = 0;
-      for (y = 1; y < num_ssa_names; y++)
-        {
-	  p = partition_find (map->var_partition, y);
-	  if (map->partition_to_view)
-	    p = map->partition_to_view[p];
-	  if (p == (int)x)
-	    {
-	      if (t++ == 0)
-	        {
-		  fprintf (f, "Partition %d (", x);
-		  print_generic_expr (f, partition_to_var (map, p), TDF_SLIM);
-		  fprintf (f, " - ");
-		}
-	      fprintf (f, "%d ", y);
-	    }
+      if (head[x] != -1)
+	{
+	  fprintf (f, "Partition %d (", x);
+	  print_generic_expr (f, partition_to_var (map, x), TDF_SLIM);
+	  fprintf (f, " - ");
+	  for (y = head[x]; y != -1; y = next[y])
+	    fprintf (f, "%d ", y);
+	  fprintf (f, ")\n");
 	}
-      if (t != 0)
-	fprintf (f, ")\n");
     }
   fprintf (f, "\n");
+
+  free (next);
+  free (head);
 }
 
 
@@ -1432,6 +1490,7 @@ verify_live_on_entry (tree_live_info_p live)
   int num;
   edge_iterator ei;
   var_map map = live->map;
+  unsigned num_parts = num_var_partitions (map);
 
    /* Check for live on entry partitions and report those with a DEF in
       the program. This will typically mean an optimization has done
@@ -1443,7 +1502,7 @@ verify_live_on_entry (tree_live_info_p live)
       int entry_block = e->dest->index;
       if (e->dest == EXIT_BLOCK_PTR_FOR_FN (cfun))
         continue;
-      for (i = 0; i < (unsigned)num_var_partitions (map); i++)
+      for (i = 0; i < num_parts; i++)
 	{
 	  basic_block tmp;
 	  tree d = NULL_TREE;